@@ -47,15 +47,15 @@ namespace OpenTissue
         {
           ++stamp;
 
-          point_type o = origin(*data);
-          point_type d = destination(*data);
+          point_type o = collision_policy::origin(*data);
+          point_type d = collision_policy::destination(*data);
           point_type u = d - o;
           real_type s = 0;
-          triplet_type T = get_triplet(o);
+          triplet_type T = hash_grid::get_triplet(o);
 
           while (s<=1)
           {
-            cell_type & cell = get_cell(T);
+            cell_type & cell = hash_grid::get_cell(T);
             if(cell.m_query_stamp!=stamp)
             {
               cell.m_query_stamp=stamp;
@@ -80,15 +80,15 @@ namespace OpenTissue
         real_type dx = this->get_spacing();
         for(data_iterator data = begin;data!=end;++data)
         {
-          point_type o = origin(*data);
-          point_type d = destination(*data);
+          point_type o = collision_policy::origin(*data);
+          point_type d = collision_policy::destination(*data);
           point_type u = d - o;
           real_type s = 0;
-          triplet_type T = get_triplet(o);
+          triplet_type T = hash_grid::get_triplet(o);
 
           while (s<=1)
           {
-            cell_type & cell = get_cell(T);
+            cell_type & cell = hash_grid::get_cell(T);
             cell.remove( *data );
             update_parameters(T,dx,o,u,parameters);
             s = find_indices(parameters,s,indices);
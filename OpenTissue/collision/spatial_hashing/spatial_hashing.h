@@ -19,6 +19,7 @@
 #include <OpenTissue/collision/spatial_hashing/hash_queries/spatial_hashing_aabb_data_query.h>
 
 #include <OpenTissue/collision/spatial_hashing/spatial_hashing_grid.h>
+#include <OpenTissue/collision/spatial_hashing/spatial_hashing_compact_grid.h>
 
 // OPENTISSUE_COLLISION_SPATIAL_HASHING_H
 #endif
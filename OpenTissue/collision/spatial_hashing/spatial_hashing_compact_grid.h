@@ -0,0 +1,399 @@
+#ifndef OPENTISSUE_COLLISION_SPATIAL_HASHING_SPATIAL_HASHING_COMPACT_GRID_H
+#define OPENTISSUE_COLLISION_SPATIAL_HASHING_SPATIAL_HASHING_COMPACT_GRID_H
+//
+// OpenTissue Template Library
+// - A generic toolbox for physics-based modeling and simulation.
+// Copyright (C) 2008 Department of Computer Science, University of Copenhagen.
+//
+// OTTL is licensed under zlib: http://opensource.org/licenses/zlib-license.php
+//
+#include <OpenTissue/configuration.h>
+
+#include <boost/iterator/indirect_iterator.hpp>
+
+#include <vector>
+#include <cmath>
+#include <cassert>
+
+namespace OpenTissue
+{
+  namespace spatial_hashing
+  {
+
+    /**
+    * Compact Hash Grid.
+    * This class is a drop-in replacement for the Grid class, it supports the
+    * same hash functions and the same queries. The difference lies in how
+    * data is stored.
+    *
+    * The Grid class gives every hash cell its own data container, which
+    * is pre-allocated to hold 16 pointers. For large hash tables this means
+    * that most memory is spent on empty cells and that data is scattered
+    * all over the heap.
+    *
+    * This class stores all data in a single flat array sorted by hash cell
+    * (a compressed sparse row layout). A hash cell only holds its query
+    * stamp and a pointer to the grid, the extent of its data is looked up
+    * in an offset array shared by all cells.
+    *
+    * Data added to a cell is first appended to a staging array. The first
+    * time any cell is read afterwards, the flat array is rebuilt by a
+    * counting sort over the hash keys, that is in time linear in the
+    * number of data and cells. Data in a cell keeps the order in which it
+    * was added. Data can be removed without a rebuild.
+    *
+    * Thus a typical frame, where the grid is cleared, all data is mapped
+    * and then queried, costs one rebuild.
+    */
+    template <
+      typename real_vector3
+      , typename int_vector3
+      , typename data_type_
+      , typename hash_function_type
+    >
+    class CompactGrid
+    {
+    public:
+      typedef          data_type_                                   data_type;
+      typedef typename real_vector3::value_type                     real_type;
+      typedef          int_vector3                                  triplet_type;   ///< Type of discretized points.
+      typedef          real_vector3                                 point_type;     ///< Type of continuous points.
+
+    protected:
+
+      typedef std::vector<data_type*>                               data_ptr_container;
+
+      /**
+      * Staged Data Entry.
+      */
+      struct Entry
+      {
+        size_t      m_key;    ///< The hash key of the cell that the data was added to.
+        data_type * m_data;   ///< The data.
+      };
+
+    protected:
+
+      class Cell
+      {
+      public:
+
+        typedef boost::indirect_iterator<data_type**,data_type> data_iterator;
+
+      public:
+
+        CompactGrid * m_owner;        ///< The hash table the cell belongs to.
+        size_t        m_query_stamp;  ///< Timestamp, used to guard against hash-collisions.
+
+      public:
+
+        Cell()
+          : m_owner(0)
+          , m_query_stamp(0)
+        {}
+
+        Cell( CompactGrid * owner )
+          : m_owner(owner)
+          , m_query_stamp(0)
+        {}
+
+      public:
+
+        data_iterator begin()
+        {
+          assert(m_owner);
+          return data_iterator( m_owner->cell_begin( key() ) );
+        }
+
+        data_iterator end()
+        {
+          assert(m_owner);
+          size_t const k = key();
+          return data_iterator( m_owner->cell_begin( k ) + m_owner->m_count[k] );
+        }
+
+      public:
+
+        void add(data_type const & data)
+        {
+          assert(m_owner);
+          Entry entry;
+          entry.m_key  = key();
+          entry.m_data = const_cast<data_type*>(&data);
+          m_owner->m_staged.push_back( entry );
+        }
+
+        bool remove(data_type & data)
+        {
+          assert(m_owner || !"Cell::remove(): owner was null");
+
+          data_type * tmp = const_cast<data_type*>(&data);
+          size_t const k = key();
+          data_type ** first = m_owner->cell_begin( k );
+          size_t & count = m_owner->m_count[k];
+          for(size_t i=0;i<count;++i)
+          {
+            if( first[i] == tmp )
+            {
+              first[i] = first[count-1];
+              first[count-1] = 0;
+              --count;
+              return true;
+            }
+          }
+          return false;
+        }
+
+        bool empty() const
+        {
+          return size() == 0;
+        }
+
+        size_t size() const
+        {
+          assert(m_owner);
+          size_t const k = key();
+          m_owner->update();
+          return m_owner->m_count[k];
+        }
+
+      protected:
+
+        size_t key() const
+        {
+          return static_cast<size_t>( this - &m_owner->m_cells[0] );
+        }
+
+      };
+
+    public:
+
+      typedef Cell                                  cell_type;
+      typedef typename std::vector< cell_type >     cell_storage;
+
+    protected:
+
+      real_type               m_delta;            ///< Grid cell spacing.
+      hash_function_type      m_hash_function;
+      cell_storage            m_cells;            ///< Hash table cells.
+      std::vector<size_t>     m_offset;           ///< The data of cell k starts at m_data[m_offset[k]].
+      std::vector<size_t>     m_count;            ///< The number of data in cell k.
+      data_ptr_container      m_data;             ///< Data of all cells, sorted by hash key.
+      std::vector<Entry>      m_staged;           ///< Data added since last rebuild.
+      bool                    m_cleared;          ///< Set if the data array is logically empty.
+
+    public:
+
+      typedef typename cell_storage::iterator cell_iterator;
+
+      cell_iterator begin(){return m_cells.begin();}
+      cell_iterator end(){return m_cells.end();}
+
+    public:
+
+      CompactGrid( )
+        : m_delta(5.0)
+        , m_cleared(true)
+      {
+        resize(1000);
+      }
+
+      CompactGrid( size_t size )
+        : m_delta(5.0)
+        , m_cleared(true)
+      {
+        resize( size );
+      }
+
+      CompactGrid( CompactGrid const & grid ) { *this = grid; }
+
+      CompactGrid & operator=( CompactGrid const & grid )
+      {
+        m_delta         = grid.m_delta;
+        m_hash_function = grid.m_hash_function;
+        m_cells         = grid.m_cells;
+        m_offset        = grid.m_offset;
+        m_count         = grid.m_count;
+        m_data          = grid.m_data;
+        m_staged        = grid.m_staged;
+        m_cleared       = grid.m_cleared;
+        for(size_t k = 0; k < m_cells.size(); ++k)
+          m_cells[k].m_owner = this;
+        return *this;
+      }
+
+    public:
+
+      /**
+      * Resize Hash Table.
+      * Observe that this clears all data from the hash table, since the hash
+      * keys change with the table size.
+      *
+      * @param size   The requested number of hash cells, the hash function
+      *               decides the actual number.
+      */
+      void resize( size_t size )
+      {
+        m_hash_function.resize(size);
+        m_cells.assign( m_hash_function.size(), Cell(this) );
+        m_offset.assign( m_hash_function.size() + 1, 0 );
+        m_count.assign( m_hash_function.size(), 0 );
+        clear();
+      }
+
+      size_t size( ) const  { return m_hash_function.size(); }
+
+      /**
+      * Set Grid Cell Spacing.
+      * See Grid::set_spacing() for details.
+      *
+      * @param delta   The new grid cell spacing size, must be a positive number.
+      */
+      void set_spacing( real_type delta )
+      {
+        assert( delta > 0 );
+        m_delta = delta;
+      }
+
+      real_type get_spacing( ) const { return m_delta; }
+
+      /**
+      * Point Discretization.
+      *
+      * @param p   A 3D point in continious space
+      *
+      * @return    A discretized point identifying the grid
+      *            cell (not the hash cell!) which the contineous
+      *            point lies inside.
+      */
+      triplet_type get_triplet( point_type const & point )const
+      {
+        typedef typename triplet_type::value_type value_type;
+        assert( m_delta > 0 );
+        return triplet_type(
+          static_cast<value_type>( std::floor( point(0) / m_delta ) ),
+          static_cast<value_type>( std::floor( point(1) / m_delta ) ),
+          static_cast<value_type>( std::floor( point(2) / m_delta ) )
+          );
+      }
+
+      /**
+      * Find the hash cell containing the grid cell enclosing the continuous point.
+      */
+      cell_type & get_cell(point_type const & p)
+      {
+        triplet_type triplet = get_triplet(p);
+        size_t hash_key = m_hash_function( triplet(0), triplet(1), triplet(2) );
+        return m_cells[ hash_key ];
+      }
+
+      /**
+      * Find the hash cell containing the grid cell enclosing the discretized point.
+      */
+      cell_type & get_cell(triplet_type const & triplet)
+      {
+        size_t hash_key = m_hash_function( triplet(0), triplet(1), triplet(2) );
+        return m_cells[ hash_key ];
+      }
+
+      void clear()
+      {
+        m_staged.clear();
+        m_cleared = true;
+      }
+
+      /**
+      * Get Memory Usage.
+      *
+      * @return   The number of bytes allocated by the hash table.
+      */
+      size_t memory() const
+      {
+        return sizeof(CompactGrid)
+          + m_cells.capacity()*sizeof(Cell)
+          + m_offset.capacity()*sizeof(size_t)
+          + m_count.capacity()*sizeof(size_t)
+          + m_data.capacity()*sizeof(data_type*)
+          + m_staged.capacity()*sizeof(Entry);
+      }
+
+    protected:
+
+      data_type ** cell_begin(size_t const & key)
+      {
+        update();
+        return m_data.empty() ? 0 : &m_data[0] + m_offset[key];
+      }
+
+      /**
+      * Update Data Array.
+      * Merges any staged data into the data array by a counting sort on the
+      * hash keys. The data already stored in a cell is kept in front of the
+      * staged data of that cell.
+      */
+      void update()
+      {
+        if(m_staged.empty() && !m_cleared)
+          return;
+
+        size_t const cells = m_cells.size();
+
+        if(m_cleared)
+        {
+          m_count.assign( cells, 0 );
+        }
+        else
+        {
+          // Move the currently stored data in front of the staged data, such
+          // that the insertion order of each cell is preserved.
+          size_t total = 0;
+          for(size_t k = 0; k < cells; ++k)
+            total += m_count[k];
+          std::vector<Entry> merged;
+          merged.reserve( total + m_staged.size() );
+          for(size_t k = 0; k < cells; ++k)
+          {
+            for(size_t i = m_offset[k]; i < m_offset[k] + m_count[k]; ++i)
+            {
+              Entry entry;
+              entry.m_key  = k;
+              entry.m_data = m_data[i];
+              merged.push_back( entry );
+            }
+          }
+          merged.insert( merged.end(), m_staged.begin(), m_staged.end() );
+          m_staged.swap( merged );
+          m_count.assign( cells, 0 );
+        }
+        m_cleared = false;
+
+        //--- Count the data of each cell and compute the offsets by a prefix sum
+        size_t const total = m_staged.size();
+        for(size_t i = 0; i < total; ++i)
+          ++m_count[ m_staged[i].m_key ];
+
+        m_offset[0] = 0;
+        for(size_t k = 0; k < cells; ++k)
+          m_offset[k+1] = m_offset[k] + m_count[k];
+
+        //--- Scatter the data into place, the counts are reused as cursors
+        m_data.resize( total );
+        m_count.assign( cells, 0 );
+        for(size_t i = 0; i < total; ++i)
+        {
+          size_t const k = m_staged[i].m_key;
+          m_data[ m_offset[k] + m_count[k] ] = m_staged[i].m_data;
+          ++m_count[k];
+        }
+
+        m_staged.clear();
+      }
+
+    };
+
+  } // namespace spatial_hashing
+
+} // namespace OpenTissue
+
+// OPENTISSUE_COLLISION_SPATIAL_HASHING_SPATIAL_HASHING_COMPACT_GRID_H
+#endif
@@ -309,10 +309,10 @@ namespace OpenTissue
 
         ++m_query_stamp;
 
-        point_type       min_corner = min_coord(query); //--- by collision_policy
-        point_type       max_corner = max_coord(query); //--- by collision_policy
-        triplet_type     m          = get_triplet(min_corner);
-        triplet_type     M          = get_triplet(max_corner);
+        point_type       min_corner = collision_policy::min_coord(query); //--- by collision_policy
+        point_type       max_corner = collision_policy::max_coord(query); //--- by collision_policy
+        triplet_type     m          = hash_grid::get_triplet(min_corner);
+        triplet_type     M          = hash_grid::get_triplet(max_corner);
 
         assert( m(0) <= M(0) || !"Minimum was larger than maximum");
         assert( m(1) <= M(1) || !"Minimum was larger than maximum");
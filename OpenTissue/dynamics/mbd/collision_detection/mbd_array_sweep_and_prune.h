@@ -0,0 +1,658 @@
+#ifndef OPENTISSUE_DYNAMICS_MBD_COLLISION_DETECTION_MBD_ARRAY_SWEEP_AND_PRUNE_H
+#define OPENTISSUE_DYNAMICS_MBD_COLLISION_DETECTION_MBD_ARRAY_SWEEP_AND_PRUNE_H
+//
+// OpenTissue Template Library
+// - A generic toolbox for physics-based modeling and simulation.
+// Copyright (C) 2008 Department of Computer Science, University of Copenhagen.
+//
+// OTTL is licensed under zlib: http://opensource.org/licenses/zlib-license.php
+//
+#include <OpenTissue/configuration.h>
+
+#include <OpenTissue/core/math/math_constants.h>
+
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+namespace OpenTissue
+{
+  namespace mbd
+  {
+
+    /**
+    * The Array Based Sweep N' Prune Broad Phase Collision Detection Algorithm.
+    *
+    * This is a drop-in replacement for the SweepNPrune broad phase policy. All
+    * data lives in contiguous arrays:
+    *
+    *  - Every body owns a proxy. The AABB bounds of all proxies are stored
+    *    as one array per axis and per bound (structure of arrays).
+    *  - Every coordinate axis is a sorted array of endpoint values together
+    *    with a parallel array of packed endpoint tags (proxy index times two,
+    *    plus one for an end point).
+    *  - The currently overlapping pairs are kept in an array, each edge knows
+    *    its position in the array, so pairs are added and removed in constant
+    *    time.
+    *
+    * Two sorting modes are supported:
+    *
+    *  - Incremental (default): All three axes are kept sorted by insertion
+    *    sort, which runs in expected linear time due to temporal coherence.
+    *    Whenever a begin point passes an end point the pair is tested for
+    *    overlap on all axes and added, whenever an end point passes a begin
+    *    point the pair is removed. Resting bodies cause no swaps at all, so
+    *    the cost of a mostly settled scene is a linear scan over the arrays.
+    *
+    *  - Variance axis: Only a single axis is kept sorted, the axis along which
+    *    the AABB centers have the largest variance. The overlaps are found by
+    *    sweeping that axis and testing the two other axes directly. This mode
+    *    is preferable when objects are spread out along one direction and move
+    *    a lot, since the incremental mode then has to do a lot of swaps on the
+    *    two other axes.
+    *
+    * In both modes the pairs are persistent. The edges that started
+    * overlapping and the edges that stopped overlapping during the last
+    * invocation of run are available through get_added() and get_removed().
+    */
+    template<typename types>
+    class ArraySweepAndPrune
+    {
+    protected:
+
+      typedef typename types::math_policy::index_type      size_type;
+      typedef typename types::math_policy::real_type       real_type;
+      typedef typename types::math_policy::value_traits    value_traits;
+      typedef typename types::math_policy::vector3_type    vector3_type;
+      typedef typename types::math_policy::matrix3x3_type  matrix3x3_type;
+      typedef typename types::configuration_type           configuration_type;
+      typedef typename types::body_type                    body_type;
+      typedef typename types::edge_type                    edge_type;
+      typedef typename types::edge_ptr_container           edge_ptr_container;
+
+      /**
+      * Overlapping Pair.
+      */
+      struct Pair
+      {
+        size_type   m_A;      ///< The proxy index of the first body.
+        size_type   m_B;      ///< The proxy index of the second body.
+        edge_type * m_edge;   ///< The contact graph edge of the pair.
+      };
+
+      static size_type undefined() { return ~size_type(0u); }
+
+    protected:
+
+      configuration_type *     m_configuration;     ///< A pointer to the configuration that the broad phase works on.
+
+      std::vector<body_type*>  m_bodies;            ///< The body of each proxy, null if the proxy is unused.
+      std::vector<real_type>   m_min[3];            ///< The lower AABB bound of each proxy along each axis.
+      std::vector<real_type>   m_max[3];            ///< The upper AABB bound of each proxy along each axis.
+      std::vector<size_type>   m_free;              ///< Indices of unused proxies.
+
+      std::vector<real_type>   m_values[3];         ///< Sorted endpoint values along each axis.
+      std::vector<size_type>   m_tags[3];           ///< Endpoint tags along each axis, proxy*2 + (is end point).
+      std::vector<size_type>   m_order;             ///< Proxies sorted by lower bound along the sweep axis (variance mode only).
+
+      std::vector<Pair>        m_pairs;             ///< The currently overlapping pairs.
+      std::vector<edge_type*>  m_added;             ///< Edges that started overlapping during last run.
+      std::vector<edge_type*>  m_removed;           ///< Edges that stopped overlapping during last run.
+
+      bool                     m_use_variance_axis; ///< Boolean flag indicating whether only the axis of largest variance is sorted, default is false.
+      bool                     m_dirty;             ///< Set when the sorted arrays must be rebuilt from scratch.
+      size_type                m_axis;              ///< The current sweep axis (variance mode only).
+      size_type                m_stamp;             ///< Incremented on every run, used for detecting vanished pairs in variance mode.
+
+    public:
+
+      class node_traits
+      {
+      public:
+        node_traits() : m_asap_proxy( ~size_type(0u) ) {}
+      public:
+        size_type m_asap_proxy;           ///< The index of the proxy of the body.
+      };
+
+      class edge_traits
+      {
+      public:
+        edge_traits() : m_asap_pair( ~size_type(0u) ), m_asap_stamp(0u) {}
+      public:
+        size_type m_asap_pair;            ///< The index of the edge in the pair array, undefined if not overlapping.
+        size_type m_asap_stamp;           ///< The stamp of the last run that found the pair overlapping (variance mode only).
+      };
+
+      class constraint_traits {  };
+
+    public:
+
+      ArraySweepAndPrune()
+        : m_configuration(0)
+        , m_use_variance_axis(false)
+        , m_dirty(true)
+        , m_axis(0u)
+        , m_stamp(0u)
+      {}
+
+    public:
+
+      /**
+      * Set Variance Axis Mode.
+      *
+      * @param value   If true then only the axis with the largest variance of
+      *                AABB centers is sorted, otherwise all three axes are
+      *                sorted incrementally.
+      */
+      void set_use_variance_axis(bool const & value)
+      {
+        if(value != m_use_variance_axis)
+          m_dirty = true;
+        m_use_variance_axis = value;
+      }
+
+      bool use_variance_axis() const { return m_use_variance_axis; }
+
+      std::vector<edge_type*> const & get_added()   const { return m_added;   }
+      std::vector<edge_type*> const & get_removed() const { return m_removed; }
+
+      size_type size_pairs() const { return m_pairs.size(); }
+
+    public:
+
+      /**
+      * Clear.
+      * Note that bodies and edges may already have been destroyed when this
+      * method is invoked, thus their traits are left untouched. Stale traits
+      * are detected by is_reported() and overwritten by add().
+      */
+      void clear()
+      {
+        m_bodies.clear();
+        m_free.clear();
+        for(size_type axis = 0u; axis < 3u; ++axis)
+        {
+          m_min[axis].clear();
+          m_max[axis].clear();
+          m_values[axis].clear();
+          m_tags[axis].clear();
+        }
+        m_order.clear();
+        m_pairs.clear();
+        m_added.clear();
+        m_removed.clear();
+        m_dirty = true;
+        m_configuration = 0;
+      }
+
+      void init(configuration_type & configuration)
+      {
+        clear();
+        m_configuration = &configuration;
+      }
+
+      void add(body_type * body)
+      {
+        assert(m_configuration);
+        assert(!is_added(body) || !"ArraySweepAndPrune::add(): body was already added");
+
+        size_type proxy = m_bodies.size();
+        if(!m_free.empty())
+        {
+          proxy = m_free.back();
+          m_free.pop_back();
+          m_bodies[proxy] = body;
+        }
+        else
+        {
+          m_bodies.push_back(body);
+          for(size_type axis = 0u; axis < 3u; ++axis)
+          {
+            m_min[axis].push_back( value_traits::zero() );
+            m_max[axis].push_back( value_traits::zero() );
+          }
+        }
+        body->m_asap_proxy = proxy;
+
+        // The endpoints are appended to the end of the axes, that is as if the
+        // body was placed at infinity. The next sort moves them into place and
+        // reports all overlaps on the way.
+        real_type const infinity = math::detail::highest<real_type>();
+        for(size_type axis = 0u; axis < 3u; ++axis)
+        {
+          m_min[axis][proxy] = infinity;
+          m_max[axis][proxy] = infinity;
+          m_values[axis].push_back(infinity);
+          m_tags[axis].push_back(2u*proxy);
+          m_values[axis].push_back(infinity);
+          m_tags[axis].push_back(2u*proxy + 1u);
+        }
+        if(m_use_variance_axis)
+          m_dirty = true;
+      }
+
+      void remove(body_type * body)
+      {
+        assert(m_configuration);
+
+        if(!is_added(body))
+          return;
+        size_type const proxy = body->m_asap_proxy;
+
+        // Note that the configuration destroys the edges of the body before
+        // the body is removed from the collision detection, thus the pairs
+        // are found by their proxies and the edges must not be touched.
+        for(size_type i = 0u; i < m_pairs.size(); )
+        {
+          if(m_pairs[i].m_A == proxy || m_pairs[i].m_B == proxy)
+            erase_pair(i);
+          else
+            ++i;
+        }
+        m_added.clear();
+        m_removed.clear();
+
+        for(size_type axis = 0u; axis < 3u; ++axis)
+        {
+          size_type k = 0u;
+          for(size_type e = 0u; e < m_tags[axis].size(); ++e)
+          {
+            if( (m_tags[axis][e] >> 1) == proxy)
+              continue;
+            m_values[axis][k] = m_values[axis][e];
+            m_tags[axis][k]   = m_tags[axis][e];
+            ++k;
+          }
+          m_values[axis].resize(k);
+          m_tags[axis].resize(k);
+        }
+        m_order.erase( std::remove(m_order.begin(), m_order.end(), proxy), m_order.end() );
+
+        m_bodies[proxy] = 0;
+        m_free.push_back(proxy);
+        body->m_asap_proxy = undefined();
+      }
+
+      /**
+      * Run Sweep N' Prune Algorithm.
+      *
+      * @param edges   Upon return this argument holds all the currently
+      *                overlapping pairs, as pointers to the respective
+      *                contact graph edges.
+      */
+      void run(edge_ptr_container & edges)
+      {
+        assert(m_configuration);
+
+        ++m_stamp;
+        m_added.clear();
+        m_removed.clear();
+
+        update_bounds();
+
+        if(m_use_variance_axis)
+        {
+          size_type const axis = compute_variance_axis();
+          if(m_dirty || axis != m_axis)
+          {
+            m_axis = axis;
+            rebuild_order();
+          }
+          else
+          {
+            sort_order();
+          }
+          sweep();
+        }
+        else
+        {
+          if(m_dirty)
+          {
+            rebuild_axes();
+            m_axis = 0u;
+            rebuild_order();
+            sweep();
+            m_order.clear();
+          }
+          else
+          {
+            for(size_type axis = 0u; axis < 3u; ++axis)
+              sort_axis(axis);
+          }
+        }
+        m_dirty = false;
+
+        edges.clear();
+        for(size_type i = 0u; i < m_pairs.size(); ++i)
+          edges.push_back( m_pairs[i].m_edge );
+      }
+
+    protected:
+
+      /**
+      * Update Bounds.
+      * Recomputes the AABB of every body and copies the new values into the
+      * endpoint arrays, the endpoint arrays are left unsorted.
+      */
+      void update_bounds()
+      {
+        real_type const envelope = m_configuration->get_collision_envelope();
+
+        vector3_type pmin,pmax,r;
+        matrix3x3_type R;
+        for(size_type p = 0u; p < m_bodies.size(); ++p)
+        {
+          body_type * body = m_bodies[p];
+          if(!body)
+            continue;
+          body->get_position(r);
+          body->get_orientation(R);
+          body->compute_collision_aabb(r,R,pmin,pmax,envelope);
+          for(size_type axis = 0u; axis < 3u; ++axis)
+          {
+            m_min[axis][p] = pmin(axis);
+            m_max[axis][p] = pmax(axis);
+          }
+        }
+
+        for(size_type axis = 0u; axis < 3u; ++axis)
+        {
+          real_type const * lower = &m_min[axis][0];
+          real_type const * upper = &m_max[axis][0];
+          size_type const count   = m_tags[axis].size();
+          for(size_type e = 0u; e < count; ++e)
+          {
+            size_type const tag = m_tags[axis][e];
+            m_values[axis][e] = (tag & 1u) ? upper[tag >> 1] : lower[tag >> 1];
+          }
+        }
+      }
+
+      bool is_added(body_type const * body) const
+      {
+        size_type const proxy = body->m_asap_proxy;
+        return proxy < m_bodies.size() && m_bodies[proxy] == body;
+      }
+
+      bool is_reported(edge_type const * edge) const
+      {
+        size_type const i = edge->m_asap_pair;
+        return i < m_pairs.size() && m_pairs[i].m_edge == edge;
+      }
+
+      /**
+      * Test if two proxies overlap along all three axes.
+      */
+      bool overlap(size_type const & a, size_type const & b) const
+      {
+        for(size_type axis = 0u; axis < 3u; ++axis)
+        {
+          if(m_min[axis][a] > m_max[axis][b] || m_min[axis][b] > m_max[axis][a])
+            return false;
+        }
+        return true;
+      }
+
+      void add_pair(size_type const & a, size_type const & b)
+      {
+        body_type * A = m_bodies[a];
+        body_type * B = m_bodies[b];
+        edge_type * edge = m_configuration->get_edge(A,B);
+        if(!edge)
+          edge = m_configuration->add(A,B);
+        edge->m_asap_stamp = m_stamp;
+        if(is_reported(edge))
+          return;
+        Pair pair;
+        pair.m_A    = a;
+        pair.m_B    = b;
+        pair.m_edge = edge;
+        edge->m_asap_pair = m_pairs.size();
+        m_pairs.push_back(pair);
+        m_added.push_back(edge);
+      }
+
+      void remove_pair(size_type const & a, size_type const & b)
+      {
+        edge_type * edge = m_configuration->get_edge(m_bodies[a],m_bodies[b]);
+        if(!edge || !is_reported(edge))
+          return;
+        m_removed.push_back(edge);
+        erase_pair(edge->m_asap_pair);
+        edge->m_asap_pair = undefined();
+      }
+
+      /**
+      * Erase Pair.
+      * Removes the i'th pair by moving the last pair into its place. The
+      * edge of the erased pair is not accessed.
+      */
+      void erase_pair(size_type const & i)
+      {
+        size_type const last = m_pairs.size() - 1u;
+        if(i != last)
+        {
+          m_pairs[i] = m_pairs[last];
+          m_pairs[i].m_edge->m_asap_pair = i;
+        }
+        m_pairs.pop_back();
+      }
+
+      /**
+      * Wrongly Sorted Query Method.
+      * Values must be sorted in increasing order and begin points must come
+      * before end points with the same value.
+      */
+      static bool is_wrong(real_type const & left_value, size_type const & left_tag, real_type const & right_value, size_type const & right_tag)
+      {
+        if(right_value < left_value)
+          return true;
+        if(right_value == left_value)
+          return ((right_tag & 1u) == 0u) && ((left_tag & 1u) == 1u);
+        return false;
+      }
+
+      /**
+      * Coordinate Sorting Algorithm.
+      * Insertion sort of a single axis, the pairs are updated whenever a
+      * begin point and an end point swaps place.
+      */
+      void sort_axis(size_type const & axis)
+      {
+        real_type * values = m_values[axis].empty() ? 0 : &m_values[axis][0];
+        size_type * tags   = m_tags[axis].empty()   ? 0 : &m_tags[axis][0];
+        size_type const count = m_tags[axis].size();
+
+        for(size_type e = 1u; e < count; ++e)
+        {
+          real_type const value = values[e];
+          size_type const tag   = tags[e];
+          size_type       k     = e;
+          while(k > 0u && is_wrong(values[k-1u], tags[k-1u], value, tag) )
+          {
+            size_type const left_tag = tags[k-1u];
+            bool const left_is_end   = (left_tag & 1u) == 1u;
+            bool const right_is_end  = (tag & 1u) == 1u;
+            if(left_is_end && !right_is_end)
+            {
+              // A begin point moves before an end point, the pair may start overlapping
+              if(overlap(left_tag >> 1, tag >> 1))
+                add_pair(left_tag >> 1, tag >> 1);
+            }
+            else if(!left_is_end && right_is_end)
+            {
+              // An end point moves before a begin point, the pair no longer overlaps
+              remove_pair(left_tag >> 1, tag >> 1);
+            }
+            values[k] = values[k-1u];
+            tags[k]   = left_tag;
+            --k;
+          }
+          values[k] = value;
+          tags[k]   = tag;
+        }
+      }
+
+      /**
+      * Rebuild Axes.
+      * Sorts all endpoint arrays from scratch without reporting any pairs.
+      */
+      void rebuild_axes()
+      {
+        std::vector< std::pair<real_type,size_type> > tmp;
+        for(size_type axis = 0u; axis < 3u; ++axis)
+        {
+          size_type const count = m_tags[axis].size();
+          tmp.resize(count);
+          for(size_type e = 0u; e < count; ++e)
+          {
+            // End points are ordered after begin points with the same value
+            tmp[e] = std::make_pair(m_values[axis][e], m_tags[axis][e]);
+          }
+          std::sort(tmp.begin(), tmp.end(), &ArraySweepAndPrune::less_endpoint);
+          for(size_type e = 0u; e < count; ++e)
+          {
+            m_values[axis][e] = tmp[e].first;
+            m_tags[axis][e]   = tmp[e].second;
+          }
+        }
+      }
+
+      static bool less_endpoint(std::pair<real_type,size_type> const & a, std::pair<real_type,size_type> const & b)
+      {
+        if(a.first < b.first)
+          return true;
+        if(b.first < a.first)
+          return false;
+        return (a.second & 1u) < (b.second & 1u);
+      }
+
+      /**
+      * Compute Variance Axis.
+      *
+      * @return   The axis along which the AABB centers have the largest variance.
+      */
+      size_type compute_variance_axis() const
+      {
+        real_type sum[3]    = { value_traits::zero(), value_traits::zero(), value_traits::zero() };
+        real_type sum_sq[3] = { value_traits::zero(), value_traits::zero(), value_traits::zero() };
+        size_type count = 0u;
+        for(size_type p = 0u; p < m_bodies.size(); ++p)
+        {
+          if(!m_bodies[p])
+            continue;
+          ++count;
+          for(size_type axis = 0u; axis < 3u; ++axis)
+          {
+            real_type const c = (m_min[axis][p] + m_max[axis][p]) / value_traits::two();
+            sum[axis]    += c;
+            sum_sq[axis] += c*c;
+          }
+        }
+        if(count == 0u)
+          return m_axis;
+
+        size_type best = 0u;
+        real_type best_variance = -value_traits::one();
+        for(size_type axis = 0u; axis < 3u; ++axis)
+        {
+          real_type const variance = sum_sq[axis] - sum[axis]*sum[axis]/count;
+          if(variance > best_variance)
+          {
+            best_variance = variance;
+            best = axis;
+          }
+        }
+        return best;
+      }
+
+      struct less_lower
+      {
+        std::vector<real_type> const * m_lower;
+        bool operator()(size_type const & a, size_type const & b) const { return (*m_lower)[a] < (*m_lower)[b]; }
+      };
+
+      void rebuild_order()
+      {
+        m_order.clear();
+        for(size_type p = 0u; p < m_bodies.size(); ++p)
+          if(m_bodies[p])
+            m_order.push_back(p);
+        less_lower compare;
+        compare.m_lower = &m_min[m_axis];
+        std::sort(m_order.begin(), m_order.end(), compare);
+      }
+
+      void sort_order()
+      {
+        real_type const * lower = &m_min[m_axis][0];
+        size_type const count   = m_order.size();
+        for(size_type i = 1u; i < count; ++i)
+        {
+          size_type const proxy = m_order[i];
+          real_type const value = lower[proxy];
+          size_type k = i;
+          while(k > 0u && value < lower[ m_order[k-1u] ])
+          {
+            m_order[k] = m_order[k-1u];
+            --k;
+          }
+          m_order[k] = proxy;
+        }
+      }
+
+      /**
+      * Sweep.
+      * Finds all overlapping pairs by sweeping the sorted order of the sweep
+      * axis, then removes all previously reported pairs that were not found.
+      */
+      void sweep()
+      {
+        size_type const u     = (m_axis + 1u) % 3u;
+        size_type const v     = (m_axis + 2u) % 3u;
+        size_type const count = m_order.size();
+
+        real_type const * lower  = m_min[m_axis].empty() ? 0 : &m_min[m_axis][0];
+        real_type const * upper  = m_max[m_axis].empty() ? 0 : &m_max[m_axis][0];
+        real_type const * lower_u = m_min[u].empty() ? 0 : &m_min[u][0];
+        real_type const * upper_u = m_max[u].empty() ? 0 : &m_max[u][0];
+        real_type const * lower_v = m_min[v].empty() ? 0 : &m_min[v][0];
+        real_type const * upper_v = m_max[v].empty() ? 0 : &m_max[v][0];
+
+        for(size_type i = 0u; i < count; ++i)
+        {
+          size_type const a = m_order[i];
+          for(size_type j = i + 1u; j < count; ++j)
+          {
+            size_type const b = m_order[j];
+            if(lower[b] > upper[a])
+              break;
+            if(lower_u[a] > upper_u[b] || lower_u[b] > upper_u[a])
+              continue;
+            if(lower_v[a] > upper_v[b] || lower_v[b] > upper_v[a])
+              continue;
+            add_pair(a, b);
+          }
+        }
+
+        for(size_type i = 0u; i < m_pairs.size(); )
+        {
+          edge_type * edge = m_pairs[i].m_edge;
+          if(edge->m_asap_stamp != m_stamp)
+          {
+            m_removed.push_back(edge);
+            erase_pair(i);
+            edge->m_asap_pair = undefined();
+          }
+          else
+            ++i;
+        }
+      }
+
+    };
+
+  } // namespace mbd
+} // namespace OpenTissue
+
+// OPENTISSUE_DYNAMICS_MBD_COLLISION_DETECTION_MBD_ARRAY_SWEEP_AND_PRUNE_H
+#endif
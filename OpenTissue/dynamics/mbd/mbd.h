@@ -9,6 +9,7 @@
 
 //.. refactor this >>>>
 #include <OpenTissue/dynamics/mbd/collision_detection/mbd_sweep_and_prune.h>
+#include <OpenTissue/dynamics/mbd/collision_detection/mbd_array_sweep_and_prune.h>
 #include <OpenTissue/dynamics/mbd/collision_detection/mbd_spatial_hashing.h>
 #include <OpenTissue/dynamics/mbd/collision_detection/mbd_exhaustive_search.h>
 #include <OpenTissue/dynamics/mbd/collision_detection/mbd_geometry_dispatcher.h>
@@ -37,6 +38,7 @@
 #include <OpenTissue/dynamics/mbd/forces/mbd_driving_force.h>
 
 #include <OpenTissue/dynamics/mbd/solvers/mbd_projected_gauss_seidel.h>
+#include <OpenTissue/dynamics/mbd/solvers/mbd_parallel_projected_gauss_seidel.h>
 
 #include <OpenTissue/dynamics/mbd/collision_resolvers/mbd_iterate_once_collision_resolver.h>
 #include <OpenTissue/dynamics/mbd/collision_resolvers/mbd_sequential_collision_resolver.h>
@@ -0,0 +1,325 @@
+#ifndef OPENTISSUE_DYNAMICS_MBD_UTIL_SOLVERS_MBD_PARALLEL_PROJECTED_GAUSS_SEIDEL_H
+#define OPENTISSUE_DYNAMICS_MBD_UTIL_SOLVERS_MBD_PARALLEL_PROJECTED_GAUSS_SEIDEL_H
+//
+// OpenTissue Template Library
+// - A generic toolbox for physics-based modeling and simulation.
+// Copyright (C) 2008 Department of Computer Science, University of Copenhagen.
+//
+// OTTL is licensed under zlib: http://opensource.org/licenses/zlib-license.php
+//
+#include <OpenTissue/configuration.h>
+
+#include <OpenTissue/dynamics/mbd/solvers/mbd_projected_gauss_seidel.h>
+#include <OpenTissue/utility/utility_thread_pool.h>
+
+#include <vector>
+#include <algorithm>
+
+namespace OpenTissue
+{
+  namespace mbd
+  {
+
+    /**
+    * Parallel Projected Gauss-Seidel Solver.
+    *
+    * The rows of the Jacobian are grouped into blocks of consecutive rows
+    * that touch the same bodies (typically the normal and friction rows of a
+    * single contact point or the rows of a single joint). The blocks are
+    * then greedily colored such that no two blocks of the same color share
+    * a body. The sweep visits the colors one after the other and updates
+    * all blocks of a color concurrently, the rows inside a block are updated
+    * in their original order.
+    *
+    * Bodies with a zero inverse mass block in W (fixed bodies) are ignored
+    * by the coloring. Their part of the system matrix never changes value
+    * (the corresponding W J^T entries are all zero), thus a static ground
+    * does not serialize all the contacts resting on it.
+    *
+    * The coloring only depends on the sparsity pattern of J and the block
+    * to thread mapping is static. Since blocks of the same color never
+    * touch the same data, the result does not depend on the number of
+    * threads or on the scheduling order and it is bit-identical from run to
+    * run. It is in general not bit-identical to the serial solver, since the
+    * rows are visited in a different order.
+    *
+    * If a friction row depends on a normal row outside its own block then
+    * the solver falls back to a serial sweep, since the dependency can not be
+    * captured by the coloring.
+    *
+    * The stopping criteria are the same as for the serial solver. The row
+    * residuals of the incremental merit estimate are summed in row order
+    * after each sweep, thus the decision to stop does not depend on the
+    * number of threads either.
+    */
+    template<  typename math_policy  >
+    class ParallelProjectedGaussSeidel
+      : public ProjectedGaussSeidel<math_policy>
+    {
+    protected:
+
+      typedef ProjectedGaussSeidel<math_policy>         base_class;
+
+      typedef typename math_policy::value_traits        value_traits;
+      typedef typename math_policy::real_type           real_type;
+      typedef typename math_policy::size_type           size_type;
+      typedef typename math_policy::matrix_type         matrix_type;
+      typedef typename math_policy::system_matrix_type  system_matrix_type;
+      typedef typename math_policy::vector_type         vector_type;
+      typedef typename math_policy::idx_vector_type     idx_vector_type;
+
+    protected:
+
+      OpenTissue::utility::ThreadPool * m_pool;          ///< The thread pool used for the sweeps, default is the process wide pool.
+      size_type             m_min_parallel_blocks;       ///< Colors with fewer blocks than this are swept serially, default value is 64.
+      bool                  m_serial_fallback;           ///< Set by the coloring if the rows could not be colored safely.
+
+      std::vector<size_type> m_block_begin;              ///< The rows of block b are [m_block_begin[b]..m_block_begin[b+1]).
+      std::vector<size_type> m_body_begin;               ///< The bodies of block b are m_bodies[m_body_begin[b]..m_body_begin[b+1]).
+      std::vector<size_type> m_bodies;                   ///< Body indices of all blocks.
+      std::vector<size_type> m_color_begin;              ///< The blocks of color c are m_color_blocks[m_color_begin[c]..m_color_begin[c+1]).
+      std::vector<size_type> m_color_blocks;             ///< Block indices sorted by color.
+      std::vector<real_type> m_H2;                       ///< The squared residual estimate of each row during the current sweep.
+      std::vector<real_type> m_dx;                       ///< The absolute change of each row during the current sweep.
+
+    public:
+
+      OpenTissue::utility::ThreadPool       * get_thread_pool()       { return m_pool; }
+      OpenTissue::utility::ThreadPool const * get_thread_pool() const { return m_pool; }
+
+      void set_thread_pool(OpenTissue::utility::ThreadPool & pool) { m_pool = &pool; }
+
+      size_type       & min_parallel_blocks()       { return m_min_parallel_blocks; }
+      size_type const & min_parallel_blocks() const { return m_min_parallel_blocks; }
+
+      /**
+      * Get Number of Colors.
+      *
+      * @return   The number of colors used in the last invocation of run.
+      */
+      size_type get_colors() const { return m_color_begin.empty() ? 0u : m_color_begin.size() - 1u; }
+
+      /**
+      * Get Number of Blocks.
+      *
+      * @return   The number of row blocks used in the last invocation of run.
+      */
+      size_type get_blocks() const { return m_block_begin.empty() ? 0u : m_block_begin.size() - 1u; }
+
+    public:
+
+      ParallelProjectedGaussSeidel()
+        : m_pool( &OpenTissue::utility::get_default_thread_pool() )
+        , m_min_parallel_blocks(64u)
+        , m_serial_fallback(false)
+      {}
+
+      virtual ~ParallelProjectedGaussSeidel(){}
+
+    protected:
+
+      /**
+      * Compute Coloring.
+      * Groups the rows into blocks and colors the blocks, such that no two
+      * blocks of the same color share a non-fixed body.
+      *
+      * @param J    The Jacobian matrix.
+      * @param W    The inverted mass matrix.
+      * @param pi   The dependency vector.
+      * @param m    The number of rows.
+      */
+      void compute_coloring(
+          matrix_type const & J
+        , matrix_type const & W
+        , idx_vector_type const & pi
+        , size_type const & m
+        )
+      {
+        size_type const unassigned = ~size_type(0u);
+        size_type const n = J.size2() / 6u;
+
+        m_block_begin.clear();
+        m_body_begin.clear();
+        m_bodies.clear();
+        m_color_begin.clear();
+        m_color_blocks.clear();
+        m_serial_fallback = false;
+
+        //--- A body is fixed if its diagonal block of W is zero
+        std::vector<bool> fixed(n, true);
+        for(size_type body = 0u; body < n; ++body)
+          for(size_type c = 6u*body; c < 6u*body + 6u && fixed[body]; ++c)
+            if(W(c,c) != value_traits::zero())
+              fixed[body] = false;
+
+        //--- Group consecutive rows touching the same set of bodies into blocks
+        std::vector<size_type> row_bodies;
+        size_type const row_end = J.filled1() > 0u ? J.filled1() - 1u : 0u;
+        for(size_type i = 0u; i < m; ++i)
+        {
+          row_bodies.clear();
+          if(i < row_end)
+          {
+            for(size_type k = J.index1_data()[i]; k < J.index1_data()[i + 1]; ++k)
+            {
+              size_type const body = J.index2_data()[k] / 6u;
+              if(!fixed[body] && std::find(row_bodies.begin(), row_bodies.end(), body) == row_bodies.end())
+                row_bodies.push_back(body);
+            }
+            std::sort(row_bodies.begin(), row_bodies.end());
+          }
+
+          bool same_block = !m_block_begin.empty();
+          if(same_block)
+          {
+            size_type const begin = m_body_begin.back();
+            size_type const count = m_bodies.size() - begin;
+            same_block = (count == row_bodies.size())
+              && std::equal(row_bodies.begin(), row_bodies.end(), m_bodies.begin() + begin);
+          }
+          if(!same_block)
+          {
+            m_block_begin.push_back(i);
+            m_body_begin.push_back(m_bodies.size());
+            m_bodies.insert(m_bodies.end(), row_bodies.begin(), row_bodies.end());
+          }
+
+          size_type const j = pi(i);
+          if(j < m && (j < m_block_begin.back() || j > i) )
+            m_serial_fallback = true;
+        }
+        m_block_begin.push_back(m);
+        m_body_begin.push_back(m_bodies.size());
+
+        if(m_serial_fallback)
+          return;
+
+        //--- Greedy coloring, a color keeps claiming blocks in order until all are colored
+        size_type const blocks = m_block_begin.size() - 1u;
+        std::vector<size_type> color_of_body(n, unassigned);
+        std::vector<bool>      colored(blocks, false);
+        size_type remaining    = blocks;
+        size_type first        = 0u;
+        for(size_type color = 0u; remaining > 0u; ++color)
+        {
+          m_color_begin.push_back(m_color_blocks.size());
+          while(colored[first])
+            ++first;
+          for(size_type b = first; b < blocks; ++b)
+          {
+            if(colored[b])
+              continue;
+            bool conflict = false;
+            for(size_type k = m_body_begin[b]; k < m_body_begin[b+1] && !conflict; ++k)
+              conflict = (color_of_body[ m_bodies[k] ] == color);
+            if(conflict)
+              continue;
+            for(size_type k = m_body_begin[b]; k < m_body_begin[b+1]; ++k)
+              color_of_body[ m_bodies[k] ] = color;
+            colored[b] = true;
+            m_color_blocks.push_back(b);
+            --remaining;
+          }
+        }
+        m_color_begin.push_back(m_color_blocks.size());
+      }
+
+    public:
+
+      void run(
+          matrix_type const & J
+        , matrix_type const & W
+        , vector_type const & gamma
+        , vector_type const & b
+        , vector_type & lo
+        , vector_type & hi
+        , idx_vector_type const & pi
+        , vector_type const & mu
+        , vector_type & x
+        )
+      {
+        using std::fabs;
+        using std::max;
+
+        this->init_convergence();
+
+        size_type m;
+        math_policy::get_dimension(b,m);
+
+        if(m==0)
+        {
+          this->m_status = OpenTissue::math::optimization::OK;
+          return;
+        }
+
+        math_policy::compute_system_matrix(W, J, this->m_A);
+
+        math_policy::init_system_matrix(this->m_A,x);
+
+        compute_coloring(J, W, pi, m);
+
+        m_H2.resize(m);
+        m_dx.resize(m);
+
+        for (size_type k = 0; k < this->m_iterations; ++k)
+        {
+          auto sweep_row = [&](size_type i)
+          {
+            real_type H_i;
+            real_type const dx = this->project_row(i, k, m, gamma, b, lo, hi, pi, mu, x, H_i);
+            m_H2[i] = H_i*H_i;
+            m_dx[i] = fabs(dx);
+          };
+
+          if(m_serial_fallback)
+          {
+            for (size_type i = 0; i < m; ++ i)
+              sweep_row(i);
+          }
+          else
+          {
+            for (size_type c = 0; c < get_colors(); ++c)
+            {
+              size_type const begin = m_color_begin[c];
+              size_type const end   = m_color_begin[c+1];
+
+              auto sweep_block = [&](size_t idx)
+              {
+                size_type const block = m_color_blocks[idx];
+                for (size_type i = m_block_begin[block]; i < m_block_begin[block+1]; ++i)
+                  sweep_row(i);
+              };
+
+              if( (end - begin) < m_min_parallel_blocks || m_pool->size() == 1u )
+              {
+                for (size_type idx = begin; idx < end; ++idx)
+                  sweep_block(idx);
+              }
+              else
+              {
+                m_pool->parallel_for(begin, end, sweep_block);
+              }
+            }
+          }
+
+          real_type estimate = value_traits::zero();
+          real_type max_dx   = value_traits::zero();
+          for (size_type i = 0; i < m; ++ i)
+          {
+            estimate += m_H2[i];
+            max_dx    = max(max_dx, m_dx[i]);
+          }
+          estimate /= value_traits::two();
+
+          if(this->has_converged(k, estimate, max_dx, b, lo, hi, x))
+            break;
+        }
+      }
+
+    };
+
+  } // namespace mbd
+} // namespace OpenTissue
+
+// OPENTISSUE_DYNAMICS_MBD_UTIL_SOLVERS_MBD_PARALLEL_PROJECTED_GAUSS_SEIDEL_H
+#endif
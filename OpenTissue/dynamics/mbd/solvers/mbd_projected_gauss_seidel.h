@@ -12,12 +12,38 @@
 #include <OpenTissue/dynamics/mbd/interfaces/mbd_ncp_solver_interface.h>
 #include <OpenTissue/dynamics/mbd/solvers/mbd_merit.h>
 #include <OpenTissue/core/math/math_is_number.h>
+#include <OpenTissue/core/math/optimization/optimization_constants.h>
+#include <OpenTissue/core/math/optimization/optimization_absolute_convergence.h>
+#include <OpenTissue/core/math/optimization/optimization_relative_convergence.h>
+
+#include <cmath>
 
 namespace OpenTissue
 {
   namespace mbd
   {
 
+    /**
+    * Projected Gauss-Seidel Solver.
+    *
+    * The solver runs at most m_iterations sweeps. It stops early if one of
+    * the stopping criteria is met, all of them are in-effective by default:
+    *
+    *  - Absolute convergence: The merit value dropped below the absolute tolerance.
+    *  - Relative convergence: The relative change in merit value between two sweeps dropped below the relative tolerance.
+    *  - Stagnation: The largest change of any variable during a sweep dropped below the stagnation tolerance.
+    *
+    * By default the merit value is estimated incrementally while sweeping. When
+    * the i'th variable is updated the natural residual of the i'th row is
+    * (for an unprojected update) given by
+    *
+    *   H_i = (A_ii + gamma_i) dx_i
+    *
+    * The estimate is theta = sum_i H_i^2/2 where each H_i is taken at the time
+    * of the update. It costs nothing extra and lags the true merit value by
+    * roughly one sweep. If exact_merit() is set then mbd::merit is evaluated
+    * after every sweep instead.
+    */
     template<  typename math_policy  >
     class ProjectedGaussSeidel 
       : public NCPSolverInterface<math_policy>
@@ -38,6 +64,13 @@ namespace OpenTissue
       bool                 m_profiling;     ///< Boolean flag indicating whether profiling of the solver is turned on or off. Default value is false.
       vector_type          m_theta;         ///< vector used for profiling. The i'th entry stores the value of the merit-function after the i'th iteration of the solver.
       system_matrix_type   m_A;
+      real_type            m_absolute_tolerance;    ///< The absolute tolerance on the merit value, default value is zero (in-effective).
+      real_type            m_relative_tolerance;    ///< The relative tolerance on the change in merit value, default value is zero (in-effective).
+      real_type            m_stagnation_tolerance;  ///< The tolerance on the largest change of a variable during a sweep, default value is zero (in-effective).
+      bool                 m_exact_merit;           ///< Boolean flag indicating whether the merit value is computed exactly or estimated incrementally. Default value is false.
+      real_type            m_accuracy;              ///< The merit value after the last sweep.
+      size_type            m_iteration;             ///< The number of sweeps used by the last invocation of run.
+      size_t               m_status;                ///< The status of the last invocation of run, see optimization_constants.h.
 
     public:
 
@@ -52,9 +85,50 @@ namespace OpenTissue
 
       vector_type const & theta() const { return m_theta; }
 
+      void set_absolute_tolerance(real_type const & value)
+      {
+        assert(value>=value_traits::zero() || !"ProjectedGaussSeidel::set_absolute_tolerance(): value must be non-negative");
+        m_absolute_tolerance = value;
+      }
+
+      void set_relative_tolerance(real_type const & value)
+      {
+        assert(value>=value_traits::zero() || !"ProjectedGaussSeidel::set_relative_tolerance(): value must be non-negative");
+        m_relative_tolerance = value;
+      }
+
+      void set_stagnation_tolerance(real_type const & value)
+      {
+        assert(value>=value_traits::zero() || !"ProjectedGaussSeidel::set_stagnation_tolerance(): value must be non-negative");
+        m_stagnation_tolerance = value;
+      }
 
-      real_type get_accuracy() const { return value_traits::zero(); } // Oups not implemented!
-      size_t    get_iteration() const { return 0; }                   // Oups not implemented!
+      bool       & exact_merit()       { return m_exact_merit; }
+      bool const & exact_merit() const { return m_exact_merit; }
+
+      /**
+      * Get Accuracy.
+      *
+      * @return   The merit value after the last sweep of the last invocation of run.
+      */
+      real_type get_accuracy() const { return m_accuracy; }
+
+      /**
+      * Get Iteration.
+      *
+      * @return   The number of sweeps used by the last invocation of run.
+      */
+      size_t    get_iteration() const { return m_iteration; }
+
+      /**
+      * Get Status.
+      *
+      * @return   The reason for stopping the last invocation of run. One of
+      *           OpenTissue::math::optimization::ITERATING (the maximum number
+      *           of iterations was used), ABSOLUTE_CONVERGENCE, RELATIVE_CONVERGENCE
+      *           or STAGNATION.
+      */
+      size_t    get_status() const { return m_status; }
 
 
     public:
@@ -62,10 +136,177 @@ namespace OpenTissue
       ProjectedGaussSeidel()
         : m_iterations(5)
         , m_profiling(false)
+        , m_absolute_tolerance( value_traits::zero() )
+        , m_relative_tolerance( value_traits::zero() )
+        , m_stagnation_tolerance( value_traits::zero() )
+        , m_exact_merit(false)
+        , m_accuracy( value_traits::zero() )
+        , m_iteration(0)
+        , m_status(OpenTissue::math::optimization::OK)
       {}
 
       virtual ~ProjectedGaussSeidel(){}
 
+    protected:
+
+      /**
+      * Project Row.
+      * Performs a single projected Gauss-Seidel update of the i'th
+      * variable. See the run-method for details on the update formula.
+      *
+      * The update only reads and writes the i'th entries of x, lo and hi
+      * (besides the x-entry of the dependent variable, pi(i)) and those
+      * parts of the system matrix that corresponds to the bodies of the
+      * i'th row. This is what makes it safe to update rows that touch
+      * disjoint bodies concurrently.
+      *
+      * @param i      The index of the variable to update.
+      * @param k      The current iteration number, used for taking the regularization to zero.
+      * @param m      The number of variables.
+      * @param H_i    Upon return this argument holds the estimated natural residual of the i'th row.
+      *
+      * @return       The change in the value of the i'th variable.
+      */
+      real_type project_row(
+          size_type const & i
+        , size_type const & k
+        , size_type const & m
+        , vector_type const & gamma
+        , vector_type const & b
+        , vector_type & lo
+        , vector_type & hi
+        , idx_vector_type const & pi
+        , vector_type const & mu
+        , vector_type & x
+        , real_type & H_i
+        )
+      {
+        using std::fabs;
+
+        real_type diagonal = m_A(i,i);
+
+        real_type new_x  = - b(i);
+        new_x -= math_policy::row_prod(m_A,i,x);
+
+        assert(is_number(gamma(i))             || !"ProjectedGaussSeidel::run(): not a number encountered");
+        assert(gamma(i)>= value_traits::zero() || !"ProjectedGaussSeidel::run(): gamma(i) was less than 0");
+
+        if(gamma(i) > value_traits::zero())
+        {
+          // Take regularization term lineary to zero
+          real_type alpha = value_traits::one()*(m_iterations-1-k)/(m_iterations-1);
+
+          assert(is_number(alpha)                || !"ProjectedGaussSeidel::run(): not a number encountered");
+          assert(alpha<= value_traits::one()     || !"ProjectedGaussSeidel::run(): alpha was greater than 1");
+          assert(alpha>= value_traits::zero()    || !"ProjectedGaussSeidel::run(): alpha was less than 0");
+
+          diagonal += gamma(i)*alpha;
+
+          new_x -= gamma(i)*alpha*x(i);
+          new_x /= diagonal;
+        }
+        else
+        {
+          assert(m_A(i,i)>0 || m_A(i,i)<0 || !"ProjectedGaussSeidel::run(): diagonal entry is zero?");
+          new_x /= m_A(i,i);
+        }
+
+        new_x += x(i);
+
+        assert(is_number(new_x) || !"ProjectedGaussSeidel::run(): not a number encountered");
+
+        size_type j = pi(i);
+        if (j < m )
+        {
+          assert(is_number(mu(i)) || !"ProjectedGaussSeidel::run(): not a number encountered");
+          hi(i) = fabs(mu(i)*x(j));
+          lo(i) = - hi(i);
+        }
+
+        assert(lo(i)<= value_traits::zero()  || !"ProjectedGaussSeidel::run(): lower limit was positive");
+        assert(hi(i)>= value_traits::zero()  || !"ProjectedGaussSeidel::run(): upper limit was negative");
+
+        real_type old_x = x(i);
+        if(new_x < lo(i))
+          x(i) = lo(i);
+        else if(new_x > hi(i))
+          x(i) = hi(i);
+        else
+          x(i) = new_x;
+
+        real_type dx = x(i)-old_x;
+
+        H_i = diagonal*dx;
+
+        math_policy::update_system_matrix(m_A,i,dx);
+
+        assert(is_number(x(i)) || !"ProjectedGaussSeidel::run(): not a number encountered");
+
+        return dx;
+      }
+
+      /**
+      * Reset Convergence Information.
+      * Must be invoked before the first sweep.
+      */
+      void init_convergence()
+      {
+        if(this->profiling())
+          math_policy::resize(m_theta,m_iterations);
+
+        m_accuracy  = value_traits::zero();
+        m_iteration = 0;
+        m_status    = OpenTissue::math::optimization::ITERATING;
+      }
+
+      /**
+      * Test Stopping Criteria.
+      * Must be invoked after every sweep.
+      *
+      * @param k          The iteration number of the sweep that just completed.
+      * @param estimate   The incremental estimate of the merit value of the sweep.
+      * @param max_dx     The largest absolute change of any variable during the sweep.
+      *
+      * @return           If the solver should stop then the return value is true otherwise it is false.
+      */
+      bool has_converged(
+          size_type const & k
+        , real_type const & estimate
+        , real_type const & max_dx
+        , vector_type const & b
+        , vector_type const & lo
+        , vector_type const & hi
+        , vector_type const & x
+        )
+      {
+        using namespace OpenTissue::math::optimization;
+
+        real_type const old_accuracy = m_accuracy;
+
+        m_iteration = k + 1;
+        m_accuracy  = m_exact_merit ? mbd::merit(m_A,x,b,lo,hi,math_policy()) : estimate;
+
+        if(this->profiling())
+          m_theta(k) = m_accuracy;
+
+        if(max_dx < m_stagnation_tolerance)
+        {
+          m_status = STAGNATION;
+          return true;
+        }
+        if(m_absolute_tolerance > value_traits::zero() && absolute_convergence(m_accuracy, m_absolute_tolerance) )
+        {
+          m_status = ABSOLUTE_CONVERGENCE;
+          return true;
+        }
+        if(k > 0 && m_relative_tolerance > value_traits::zero() && relative_convergence(old_accuracy, m_accuracy, m_relative_tolerance) )
+        {
+          m_status = RELATIVE_CONVERGENCE;
+          return true;
+        }
+        return false;
+      }
+
     public:
 
       void run(
@@ -81,15 +322,18 @@ namespace OpenTissue
         )  
       {
         using std::fabs;
+        using std::max;
 
-        if(this->profiling())
-          math_policy::resize(m_theta,m_iterations);
+        init_convergence();
 
         size_type m;
         math_policy::get_dimension(b,m);
 
         if(m==0)
+        {
+          m_status = OpenTissue::math::optimization::OK;
           return;
+        }
 
         math_policy::compute_system_matrix(W, J, m_A);
 
@@ -123,64 +367,19 @@ namespace OpenTissue
         //
         for (size_type k = 0; k < m_iterations; ++k)
         {
+          real_type estimate = value_traits::zero();
+          real_type max_dx   = value_traits::zero();
           for (size_type i = 0; i < m; ++ i)
           {
-            real_type new_x  = - b(i);
-            new_x -= math_policy::row_prod(m_A,i,x);
-
-            assert(is_number(gamma(i))             || !"ProjectedGaussSeidel::run(): not a number encountered");
-            assert(gamma(i)>= value_traits::zero() || !"ProjectedGaussSeidel::run(): gamma(i) was less than 0");
-
-            if(gamma(i) > value_traits::zero())
-            {
-              // Take regularization term lineary to zero
-              real_type alpha = value_traits::one()*(m_iterations-1-k)/(m_iterations-1);
-
-              assert(is_number(alpha)                || !"ProjectedGaussSeidel::run(): not a number encountered");
-              assert(alpha<= value_traits::one()     || !"ProjectedGaussSeidel::run(): alpha was greater than 1");
-              assert(alpha>= value_traits::zero()    || !"ProjectedGaussSeidel::run(): alpha was less than 0");
-
-              new_x -= gamma(i)*alpha*x(i);
-              new_x /= m_A(i,i) + gamma(i)*alpha;
-            }
-            else
-            {
-              assert(m_A(i,i)>0 || m_A(i,i)<0 || !"ProjectedGaussSeidel::run(): diagonal entry is zero?");
-              new_x /= m_A(i,i);
-            }
-
-            new_x += x(i);
-
-            assert(is_number(new_x) || !"ProjectedGaussSeidel::run(): not a number encountered");
-
-            size_type j = pi(i);
-            if (j < m )
-            {
-              assert(is_number(mu(i)) || !"ProjectedGaussSeidel::run(): not a number encountered");
-              hi(i) = fabs(mu(i)*x(j));
-              lo(i) = - hi(i);
-            }
-
-            assert(lo(i)<= value_traits::zero()  || !"ProjectedGaussSeidel::run(): lower limit was positive");
-            assert(hi(i)>= value_traits::zero()  || !"ProjectedGaussSeidel::run(): upper limit was negative");
-
-            real_type old_x = x(i);
-            if(new_x < lo(i))
-              x(i) = lo(i);
-            else if(new_x > hi(i))
-              x(i) = hi(i);
-            else
-              x(i) = new_x;
-
-            real_type dx = x(i)-old_x;
-
-            math_policy::update_system_matrix(m_A,i,dx);
-
-            assert(is_number(x(i)) || !"ProjectedGaussSeidel::run(): not a number encountered");
+            real_type H_i;
+            real_type const dx = project_row(i, k, m, gamma, b, lo, hi, pi, mu, x, H_i);
+            estimate += H_i*H_i;
+            max_dx    = max(max_dx, fabs(dx));
           }
+          estimate /= value_traits::two();
 
-          if(this->profiling())
-            m_theta(k) = mbd::merit(m_A,x,b,lo,hi,math_policy());
+          if(has_converged(k, estimate, max_dx, b, lo, hi, x))
+            break;
         }
       }
 
@@ -0,0 +1,289 @@
+#ifndef OPENTISSUE_UTILITY_UTILITY_THREAD_POOL_H
+#define OPENTISSUE_UTILITY_UTILITY_THREAD_POOL_H
+//
+// OpenTissue Template Library
+// - A generic toolbox for physics-based modeling and simulation.
+// Copyright (C) 2008 Department of Computer Science, University of Copenhagen.
+//
+// OTTL is licensed under zlib: http://opensource.org/licenses/zlib-license.php
+//
+#include <OpenTissue/configuration.h>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+namespace OpenTissue
+{
+  namespace utility
+  {
+
+    /**
+    * Thread Pool.
+    * A fork-join pool of worker threads. The calling thread always
+    * participates as thread number zero, thus a pool of size one runs
+    * everything on the calling thread and spawns no workers at all.
+    *
+    * Work is handed out in contiguous blocks with a fixed mapping from
+    * indices to threads. This means that a parallel loop visits the very
+    * same indices on the very same thread numbers every time it is
+    * invoked, which is what makes per-thread accumulation buffers
+    * reproducible.
+    *
+    * Nested invocations (a task that itself calls run() on any pool) are
+    * executed serially on the calling thread, such that parallel algorithms
+    * can be freely composed without dead-locking the pool.
+    *
+    * Example usage:
+    *
+    *   ThreadPool & pool = get_default_thread_pool();
+    *
+    *   pool.parallel_for(0, n, [&](size_t i){ y[i] = a*x[i] + y[i]; } );
+    *
+    */
+    class ThreadPool
+    {
+    protected:
+
+      typedef std::function<void(size_t)>  task_type;
+
+      std::vector<std::thread>  m_workers;      ///< The worker threads, the calling thread is not included.
+      std::mutex                m_mutex;        ///< Protects all the members below.
+      std::condition_variable   m_wake;         ///< Signaled when a new task is available or on shutdown.
+      std::condition_variable   m_done;         ///< Signaled when the last worker finishes the current task.
+      task_type const *         m_task;         ///< The task currently being executed.
+      size_t                    m_generation;   ///< Incremented for every new task, used by workers to detect new work.
+      size_t                    m_pending;      ///< Number of workers that have not yet finished the current task.
+      bool                      m_shutdown;     ///< Set when the pool is being destroyed.
+      std::exception_ptr        m_exception;    ///< First exception thrown by a worker during the current task.
+      std::mutex                m_run_mutex;    ///< Serializes run() calls from different external threads.
+
+    protected:
+
+      static bool & inside_task()
+      {
+        static thread_local bool flag = false;
+        return flag;
+      }
+
+      void worker_loop(size_t thread_number)
+      {
+        inside_task() = true;
+        size_t seen = 0u;
+        for(;;)
+        {
+          task_type const * task = 0;
+          {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&]{ return m_shutdown || m_generation != seen; });
+            if(m_shutdown)
+              return;
+            seen = m_generation;
+            task = m_task;
+          }
+          try
+          {
+            (*task)(thread_number);
+          }
+          catch(...)
+          {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(!m_exception)
+              m_exception = std::current_exception();
+          }
+          {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(--m_pending == 0u)
+              m_done.notify_one();
+          }
+        }
+      }
+
+    public:
+
+      /**
+      * Create Thread Pool.
+      *
+      * @param thread_count   The total number of threads, including the calling
+      *                       thread. A value of zero means that the number of
+      *                       hardware threads should be used.
+      */
+      explicit ThreadPool(size_t thread_count = 0u)
+        : m_task(0)
+        , m_generation(0u)
+        , m_pending(0u)
+        , m_shutdown(false)
+      {
+        if(thread_count == 0u)
+          thread_count = std::thread::hardware_concurrency();
+        if(thread_count == 0u)
+          thread_count = 1u;
+
+        m_workers.reserve(thread_count - 1u);
+        for(size_t t = 1u; t < thread_count; ++t)
+          m_workers.push_back( std::thread( &ThreadPool::worker_loop, this, t ) );
+      }
+
+      ~ThreadPool()
+      {
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_shutdown = true;
+        }
+        m_wake.notify_all();
+        for(size_t t = 0u; t < m_workers.size(); ++t)
+          m_workers[t].join();
+      }
+
+    private:
+
+      ThreadPool(ThreadPool const &);
+      ThreadPool & operator=(ThreadPool const &);
+
+    public:
+
+      /**
+      * Get Number of Threads.
+      *
+      * @return   The total number of threads used by the pool, including the calling thread.
+      */
+      size_t size() const { return m_workers.size() + 1u; }
+
+      /**
+      * Run Task.
+      * Invokes task(t) once for every thread number t in [0..size()-1] and
+      * blocks until all invocations have completed. If any invocation throws
+      * then the first exception is re-thrown on the calling thread.
+      *
+      * @param task   The task to run, it is given the thread number as argument.
+      */
+      void run(task_type const & task)
+      {
+        if(m_workers.empty() || inside_task())
+        {
+          for(size_t t = 0u; t < size(); ++t)
+            task(t);
+          return;
+        }
+
+        std::lock_guard<std::mutex> run_lock(m_run_mutex);
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_task      = &task;
+          m_pending   = m_workers.size();
+          m_exception = std::exception_ptr();
+          ++m_generation;
+        }
+        m_wake.notify_all();
+
+        std::exception_ptr master_exception;
+        inside_task() = true;
+        try
+        {
+          task(0u);
+        }
+        catch(...)
+        {
+          master_exception = std::current_exception();
+        }
+        inside_task() = false;
+
+        std::exception_ptr worker_exception;
+        {
+          std::unique_lock<std::mutex> lock(m_mutex);
+          m_done.wait(lock, [&]{ return m_pending == 0u; });
+          m_task = 0;
+          worker_exception = m_exception;
+        }
+        if(master_exception)
+          std::rethrow_exception(master_exception);
+        if(worker_exception)
+          std::rethrow_exception(worker_exception);
+      }
+
+      /**
+      * Parallel Blocked Loop.
+      * Splits the index range [begin..end) into one contiguous block per thread
+      * and invokes f(block_begin, block_end, thread_number) for every non-empty block.
+      * The split only depends on the range and the size of the pool.
+      *
+      * @param begin   The first index.
+      * @param end     One past the last index.
+      * @param f       The functor to invoke.
+      */
+      template<typename functor_type>
+      void parallel_for_blocked(size_t begin, size_t end, functor_type const & f)
+      {
+        if(end <= begin)
+          return;
+
+        size_t const count   = end - begin;
+        size_t const threads = std::min(size(), count);
+
+        if(threads == 1u)
+        {
+          f(begin, end, 0u);
+          return;
+        }
+
+        size_t const chunk = count / threads;
+        size_t const extra = count % threads;
+
+        run(
+          [&](size_t t)
+          {
+            if(t >= threads)
+              return;
+            size_t const block_begin = begin + t*chunk + std::min(t, extra);
+            size_t const block_end   = block_begin + chunk + (t < extra ? 1u : 0u);
+            f(block_begin, block_end, t);
+          }
+        );
+      }
+
+      /**
+      * Parallel Loop.
+      * Invokes f(i) for every index i in [begin..end) using the same static
+      * partitioning as parallel_for_blocked().
+      *
+      * @param begin   The first index.
+      * @param end     One past the last index.
+      * @param f       The functor to invoke.
+      */
+      template<typename functor_type>
+      void parallel_for(size_t begin, size_t end, functor_type const & f)
+      {
+        parallel_for_blocked(
+          begin
+          , end
+          , [&](size_t block_begin, size_t block_end, size_t /*t*/)
+          {
+            for(size_t i = block_begin; i < block_end; ++i)
+              f(i);
+          }
+        );
+      }
+
+    };
+
+    /**
+    * Get Default Thread Pool.
+    *
+    * @return   A reference to a process wide thread pool using all hardware threads.
+    */
+    inline ThreadPool & get_default_thread_pool()
+    {
+      static ThreadPool pool;
+      return pool;
+    }
+
+  } // namespace utility
+} // namespace OpenTissue
+
+// OPENTISSUE_UTILITY_UTILITY_THREAD_POOL_H
+#endif
@@ -0,0 +1,167 @@
+//
+// OpenTissue Template Library Demo
+// - A specific demonstration of the flexibility of OTTL.
+// Copyright (C) 2008 Department of Computer Science, University of Copenhagen.
+//
+// OTTL and OTTL Demos are licensed under zlib.
+//
+#include <OpenTissue/configuration.h>
+
+#include <OpenTissue/dynamics/mbd/math/mbd_optimized_ublas_math_policy.h>
+#include <OpenTissue/dynamics/mbd/solvers/mbd_projected_gauss_seidel.h>
+#include <OpenTissue/dynamics/mbd/solvers/mbd_parallel_projected_gauss_seidel.h>
+#include <OpenTissue/utility/utility_thread_pool.h>
+#include <OpenTissue/utility/utility_timer.h>
+
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <iostream>
+
+
+/**
+@file   This file contains a benchmark comparing the serial projected Gauss-Seidel solver with the graph-colored parallel solver.
+
+The test problem mimics a pile of boxes: the bodies are placed in a regular
+3D lattice on top of a fixed ground body. Every body touches its lattice
+neighbours and the bottom layer touches the ground. Each contact has one
+normal row and two friction rows.
+*/
+
+typedef OpenTissue::mbd::optimized_ublas_math_policy<double>  math_policy;
+typedef math_policy::matrix_type                               matrix_type;
+typedef math_policy::vector_type                               vector_type;
+typedef math_policy::idx_vector_type                           idx_vector_type;
+typedef math_policy::size_type                                 size_type;
+
+struct Problem
+{
+  matrix_type     J;
+  matrix_type     W;
+  vector_type     gamma;
+  vector_type     b;
+  vector_type     lo;
+  vector_type     hi;
+  idx_vector_type pi;
+  vector_type     mu;
+};
+
+double random_value()
+{
+  return (std::rand()/(1.0*RAND_MAX)) - 0.5;
+}
+
+void generate_pile(size_type side, size_type height, Problem & P)
+{
+  size_type const bodies   = side*side*height + 1u;  // Body zero is the ground
+  std::vector< std::pair<size_type,size_type> > contacts;
+
+  for(size_type z = 0; z < height; ++z)
+    for(size_type y = 0; y < side; ++y)
+      for(size_type x = 0; x < side; ++x)
+      {
+        size_type const body = 1u + x + y*side + z*side*side;
+        if(x+1 < side)  contacts.push_back( std::make_pair(body, body + 1u)          );
+        if(y+1 < side)  contacts.push_back( std::make_pair(body, body + side)        );
+        if(z+1 < height)contacts.push_back( std::make_pair(body, body + side*side)   );
+        if(z == 0)
+          for(size_type k = 0; k < 4; ++k)
+            contacts.push_back( std::make_pair(body, size_type(0u)) );
+      }
+
+  size_type const m = 3u*contacts.size();
+  size_type const n = 6u*bodies;
+
+  math_policy::resize(P.J,m,n);
+  math_policy::resize(P.W,n,n);
+  math_policy::resize(P.gamma,m);
+  math_policy::resize(P.b,m);
+  math_policy::resize(P.lo,m);
+  math_policy::resize(P.hi,m);
+  math_policy::resize(P.pi,m);
+  math_policy::resize(P.mu,m);
+
+  for(size_type body = 1; body < bodies; ++body)
+    for(size_type k = 6u*body; k < 6u*body + 6u; ++k)
+      P.W(k,k) = 1.0;
+
+  for(size_type c = 0; c < contacts.size(); ++c)
+  {
+    size_type const A = (std::min)(contacts[c].first, contacts[c].second);
+    size_type const B = (std::max)(contacts[c].first, contacts[c].second);
+    for(size_type r = 0; r < 3; ++r)
+    {
+      size_type const i = 3u*c + r;
+      for(size_type k = 0; k < 6; ++k)
+      {
+        P.J(i, 6u*A + k) =   random_value() + (r==0 && k==2 ? 1.0 : 0.0);
+        P.J(i, 6u*B + k) = - random_value() - (r==0 && k==2 ? 1.0 : 0.0);
+      }
+      P.pi(i) = (r==0) ? OpenTissue::math::detail::highest<size_type>() : 3u*c;
+      P.mu(i) = 0.5;
+      P.lo(i) = (r==0) ? 0.0 : -1.0;
+      P.hi(i) = (r==0) ? OpenTissue::math::detail::highest<double>() : 1.0;
+      P.b(i)  = (r==0) ? -1.0 : random_value();
+    }
+  }
+}
+
+template<typename solver_type>
+double run_solver(solver_type & solver, Problem const & P, size_type runs, vector_type & x)
+{
+  OpenTissue::utility::Timer<double> duration;
+  double total = 0.0;
+  for(size_type run = 0; run < runs; ++run)
+  {
+    vector_type lo = P.lo;
+    vector_type hi = P.hi;
+    math_policy::resize(x, P.b.size());
+    duration.start();
+    solver.run(P.J, P.W, P.gamma, P.b, lo, hi, P.pi, P.mu, x);
+    duration.stop();
+    total += duration();
+  }
+  return total / runs;
+}
+
+int main( int argc, char **argv )
+{
+  size_type const side       = (argc>1) ? std::atoi(argv[1]) : 30;
+  size_type const height     = (argc>2) ? std::atoi(argv[2]) : 6;
+  size_type const iterations = 20;
+  size_type const runs       = 5;
+
+  std::srand(0);
+
+  Problem P;
+  generate_pile(side, height, P);
+
+  std::cout << "bodies: " << side*side*height << " rows: " << P.b.size() << std::endl;
+
+  OpenTissue::mbd::ProjectedGaussSeidel<math_policy> serial;
+  serial.set_max_iterations(iterations);
+  serial.profiling() = true;
+
+  vector_type x_serial;
+  double const serial_time = run_solver(serial, P, runs, x_serial);
+  std::cout << "serial   : " << serial_time << " seconds, merit = " << serial.theta()(iterations-1) << std::endl;
+
+  for(size_type threads = 1; threads <= std::thread::hardware_concurrency(); threads *= 2)
+  {
+    OpenTissue::utility::ThreadPool pool(threads);
+
+    OpenTissue::mbd::ParallelProjectedGaussSeidel<math_policy> parallel;
+    parallel.set_thread_pool(pool);
+    parallel.set_max_iterations(iterations);
+    parallel.profiling() = true;
+
+    vector_type x_parallel;
+    double const parallel_time = run_solver(parallel, P, runs, x_parallel);
+    std::cout << "parallel : " << threads << " threads, "
+      << parallel.get_colors() << " colors, "
+      << parallel_time << " seconds, merit = " << parallel.theta()(iterations-1)
+      << ", speedup = " << serial_time/parallel_time << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,199 @@
+//
+// OpenTissue, A toolbox for physical based simulation and animation.
+// Copyright (C) 2007 Department of Computer Science, University of Copenhagen
+//
+#include <OpenTissue/configuration.h>
+
+#include <OpenTissue/core/math/math_basic_types.h>
+#include <OpenTissue/collision/spatial_hashing/spatial_hashing.h>
+
+#define BOOST_AUTO_TEST_MAIN
+#include <OpenTissue/utility/utility_push_boost_filter.h>
+#include <boost/test/auto_unit_test.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+#include <boost/test/test_tools.hpp>
+#include <OpenTissue/utility/utility_pop_boost_filter.h>
+
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+typedef OpenTissue::math::BasicMathTypes<double, size_t>  math_types;
+typedef math_types::vector3_type                          vector3_type;
+typedef OpenTissue::math::Vector3<int>                    triplet_type;
+
+struct Box
+{
+  vector3_type m_min;
+  vector3_type m_max;
+};
+
+double random_value(double lower, double upper)
+{
+  return lower + (upper - lower)*(std::rand()/(1.0*RAND_MAX));
+}
+
+void generate_boxes(size_t count, double extent, std::vector<Box> & boxes)
+{
+  boxes.resize(count);
+  for(size_t i = 0; i < count; ++i)
+  {
+    vector3_type c( random_value(-10,10), random_value(-10,10), random_value(-10,10) );
+    vector3_type h( random_value(0,extent), random_value(0,extent), random_value(0,extent) );
+    boxes[i].m_min = c - h;
+    boxes[i].m_max = c + h;
+  }
+}
+
+template<typename grid_type>
+class BoxPolicy
+{
+public:
+
+  typedef Box                      data_type;
+  typedef Box                      query_type;
+  typedef std::vector<Box const*>  result_container;
+  typedef grid_type                hash_grid;
+
+  vector3_type position ( data_type  const & data  ) const { return data.m_min;  }
+  vector3_type min_coord( data_type  const & data  ) const { return data.m_min;  }
+  vector3_type max_coord( data_type  const & data  ) const { return data.m_max;  }
+  void         reset    ( result_container & results )   { results.clear();    }
+
+  void report(data_type const & data, query_type const & query, result_container & results)
+  {
+    for(size_t i = 0; i < 3; ++i)
+      if(data.m_min(i) > query.m_max(i) || query.m_min(i) > data.m_max(i))
+        return;
+    results.push_back(&data);
+  }
+};
+
+typedef OpenTissue::spatial_hashing::PrimeNumberHashFunction  hash_function;
+typedef OpenTissue::spatial_hashing::Grid<vector3_type, triplet_type, Box, hash_function>         grid_type;
+typedef OpenTissue::spatial_hashing::CompactGrid<vector3_type, triplet_type, Box, hash_function>  compact_grid_type;
+
+typedef BoxPolicy<grid_type>          policy_type;
+typedef BoxPolicy<compact_grid_type>  compact_policy_type;
+
+typedef OpenTissue::spatial_hashing::AABBDataQuery<grid_type, policy_type>                   aabb_query_type;
+typedef OpenTissue::spatial_hashing::AABBDataQuery<compact_grid_type, compact_policy_type>   compact_aabb_query_type;
+typedef OpenTissue::spatial_hashing::PointDataQuery<grid_type, policy_type>                  point_query_type;
+typedef OpenTissue::spatial_hashing::PointDataQuery<compact_grid_type, compact_policy_type>  compact_point_query_type;
+
+template<typename query_type>
+void setup(query_type & query)
+{
+  query.resize(1000);
+  query.set_spacing(1.0);
+}
+
+BOOST_AUTO_TEST_SUITE(opentissue_collision_spatial_hashing);
+
+BOOST_AUTO_TEST_CASE(compact_grid_aabb_query)
+{
+  std::srand(0);
+  std::vector<Box> data;
+  std::vector<Box> queries;
+  generate_boxes(2000, 0.5, data);
+  generate_boxes(200, 1.0, queries);
+
+  aabb_query_type          query;
+  compact_aabb_query_type  compact_query;
+  setup(query);
+  setup(compact_query);
+
+  std::vector<Box const*> results;
+  std::vector<Box const*> compact_results;
+
+  query(data.begin(), data.end(), queries.begin(), queries.end(), results, aabb_query_type::all_tag() );
+  compact_query(data.begin(), data.end(), queries.begin(), queries.end(), compact_results, compact_aabb_query_type::all_tag() );
+  BOOST_CHECK( !results.empty() );
+  BOOST_CHECK( results == compact_results );
+
+  // Re-running the query on the mapped data must give the same result
+  query(queries.begin(), queries.end(), results, aabb_query_type::no_collisions_tag() );
+  compact_query(queries.begin(), queries.end(), compact_results, compact_aabb_query_type::no_collisions_tag() );
+  BOOST_CHECK( !results.empty() );
+  BOOST_CHECK( results == compact_results );
+
+  // Mapping new data replaces all old data
+  generate_boxes(500, 0.5, data);
+  query(data.begin(), data.end(), queries.begin(), queries.end(), results, aabb_query_type::no_collisions_tag() );
+  compact_query(data.begin(), data.end(), queries.begin(), queries.end(), compact_results, compact_aabb_query_type::no_collisions_tag() );
+  BOOST_CHECK( results == compact_results );
+}
+
+BOOST_AUTO_TEST_CASE(compact_grid_point_query)
+{
+  std::srand(1);
+  std::vector<Box> data;
+  std::vector<Box> queries;
+  generate_boxes(5000, 0.0, data);
+  generate_boxes(100, 2.0, queries);
+
+  point_query_type          query;
+  compact_point_query_type  compact_query;
+  setup(query);
+  setup(compact_query);
+
+  std::vector<Box const*> results;
+  std::vector<Box const*> compact_results;
+
+  query(data.begin(), data.end(), queries.begin(), queries.end(), results, point_query_type::no_collisions_tag() );
+  compact_query(data.begin(), data.end(), queries.begin(), queries.end(), compact_results, compact_point_query_type::no_collisions_tag() );
+  BOOST_CHECK( !results.empty() );
+  BOOST_CHECK( results == compact_results );
+
+  for(size_t i = 0; i < queries.size(); ++i)
+  {
+    query(queries[i], results, point_query_type::all_tag() );
+    compact_query(queries[i], compact_results, compact_point_query_type::all_tag() );
+    BOOST_CHECK( results == compact_results );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(compact_grid_add_and_remove_data)
+{
+  std::srand(2);
+  std::vector<Box> data;
+  std::vector<Box> queries;
+  generate_boxes(1000, 0.5, data);
+  generate_boxes(100, 1.0, queries);
+
+  compact_aabb_query_type compact_query;
+  setup(compact_query);
+
+  std::vector<Box const*> results;
+  std::vector<Box const*> expected;
+
+  // Map the data in two rounds, and remove the first half again
+  compact_query.init_data(data.begin(), data.begin() + 500);
+  compact_query(queries.begin(), queries.end(), results, compact_aabb_query_type::no_collisions_tag() );
+  compact_query.add_data(data.begin() + 500, data.end());
+  compact_query.remove_data(data.begin(), data.begin() + 500);
+  compact_query(queries.begin(), queries.end(), results, compact_aabb_query_type::no_collisions_tag() );
+
+  compact_aabb_query_type reference;
+  setup(reference);
+  reference.init_data(data.begin() + 500, data.end());
+  reference(queries.begin(), queries.end(), expected, compact_aabb_query_type::no_collisions_tag() );
+
+  BOOST_CHECK( !expected.empty() );
+  BOOST_CHECK( std::is_permutation(results.begin(), results.end(), expected.begin()) && results.size() == expected.size() );
+  for(size_t i = 0; i < results.size(); ++i)
+    BOOST_CHECK( results[i] >= &data[500] );
+}
+
+BOOST_AUTO_TEST_CASE(compact_grid_memory)
+{
+  compact_grid_type grid(100000);
+  size_t memory = sizeof(grid_type);
+  grid_type reference(100000);
+  for(grid_type::cell_iterator cell = reference.begin(); cell != reference.end(); ++cell)
+    memory += sizeof(grid_type::cell_type) + cell->m_data.capacity()*sizeof(Box*);
+  BOOST_CHECK( grid.memory() < memory/4 );
+}
+
+BOOST_AUTO_TEST_SUITE_END();
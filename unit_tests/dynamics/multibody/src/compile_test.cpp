@@ -166,3 +166,26 @@ OpenTissue::mbd::default_ublas_math_policy<double>
 
 void (*interface_ptr2)() = &(interface_compile_test<types2> );
 void (*utility_ptr2)() = &(utilities_compile_test<types2> );
+
+
+template<typename types>
+class MyArraySweepAndPruneCollisionDetection
+  : public OpenTissue::mbd::CollisionDetection<
+  types
+  , OpenTissue::mbd::ArraySweepAndPrune
+  , OpenTissue::mbd::GeometryDispatcher
+  , OpenTissue::mbd::SingleGroupAnalysis
+  >
+{};
+
+
+typedef OpenTissue::mbd::Types<
+OpenTissue::mbd::default_ublas_math_policy<double>
+, OpenTissue::mbd::NoSleepyPolicy
+, stepper_type
+, MyArraySweepAndPruneCollisionDetection
+, OpenTissue::mbd::ExplicitFixedStepSimulator
+> types3;
+
+void (*interface_ptr3)() = &(interface_compile_test<types3> );
+void (*utility_ptr3)() = &(utilities_compile_test<types3> );
@@ -0,0 +1,59 @@
+//
+// OpenTissue, A toolbox for physical based simulation and animation.
+// Copyright (C) 2007 Department of Computer Science, University of Copenhagen
+//
+#include <OpenTissue/configuration.h>
+
+#include <OpenTissue/dynamics/mbd/math/mbd_default_math_policy.h>
+#include <OpenTissue/dynamics/mbd/solvers/mbd_parallel_projected_gauss_seidel.h>
+#include <OpenTissue/dynamics/mbd/math/mbd_optimized_ublas_math_policy.h>
+
+#include <iostream>
+
+template<typename math_policy>
+void compile_test_parallel_pgs()
+{
+  using namespace OpenTissue::math::big;
+
+  typedef typename math_policy::real_type                real_type;
+  typedef typename math_policy::size_type                size_type;
+  typedef typename math_policy::value_traits             value_traits;
+  typedef typename math_policy::idx_vector_type          idx_vector_type;
+  typedef typename math_policy::vector_type              vector_type;
+  typedef typename math_policy::matrix_type              matrix_type;
+  typedef typename math_policy::system_matrix_type       system_matrix_type;
+
+  typedef typename OpenTissue::mbd::ParallelProjectedGaussSeidel<math_policy> solver_type;
+
+  solver_type solver;
+
+  size_type i = 0;
+  solver.set_max_iterations(i);
+  solver.profiling() = true;
+  solver.min_parallel_blocks() = 1u;
+
+  std::cout << solver.theta() << std::endl;
+  std::cout << solver.get_colors() << " " << solver.get_blocks() << std::endl;
+
+  matrix_type J,W;
+  vector_type gamma;
+  vector_type b;
+  vector_type lo;
+  vector_type hi;
+  idx_vector_type pi;
+  vector_type mu;
+  vector_type x;
+  solver.set_absolute_tolerance( value_traits::zero() );
+  solver.set_relative_tolerance( value_traits::zero() );
+  solver.set_stagnation_tolerance( value_traits::zero() );
+  solver.exact_merit() = false;
+  solver.run(J,W,gamma,b,lo,hi,pi,mu,x);
+
+  std::cout << solver.get_accuracy() << " " << solver.get_iteration() << " " << solver.get_status() << std::endl;
+}
+
+void (*single_precision_default_parallel_pgs)()  = &(compile_test_parallel_pgs< OpenTissue::mbd::default_ublas_math_policy<float>  > );
+void (*double_precision_default_parallel_pgs)() = &(compile_test_parallel_pgs< OpenTissue::mbd::default_ublas_math_policy<double> > );
+
+void (*single_precision_optimized_parallel_pgs)()  = &(compile_test_parallel_pgs< OpenTissue::mbd::optimized_ublas_math_policy<float>  > );
+void (*double_precision_optimized_parallel_pgs)() = &(compile_test_parallel_pgs< OpenTissue::mbd::optimized_ublas_math_policy<double> > );
@@ -41,7 +41,13 @@ void compile_test_pgs()
   idx_vector_type pi;
   vector_type mu;
   vector_type x;
+  solver.set_absolute_tolerance( value_traits::zero() );
+  solver.set_relative_tolerance( value_traits::zero() );
+  solver.set_stagnation_tolerance( value_traits::zero() );
+  solver.exact_merit() = false;
   solver.run(J,W,gamma,b,lo,hi,pi,mu,x);
+
+  std::cout << solver.get_accuracy() << " " << solver.get_iteration() << " " << solver.get_status() << std::endl;
 }
 
 void (*single_precision_default_pgs)()  = &(compile_test_pgs< OpenTissue::mbd::default_ublas_math_policy<float>  > );
@@ -0,0 +1,88 @@
+//
+// OpenTissue, A toolbox for physical based simulation and animation.
+// Copyright (C) 2007 Department of Computer Science, University of Copenhagen
+//
+#include <OpenTissue/configuration.h>
+
+#include <OpenTissue/utility/utility_thread_pool.h>
+
+#define BOOST_AUTO_TEST_MAIN
+#include <OpenTissue/utility/utility_push_boost_filter.h>
+#include <boost/test/auto_unit_test.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+#include <boost/test/test_tools.hpp>
+#include <OpenTissue/utility/utility_pop_boost_filter.h>
+
+#include <vector>
+#include <stdexcept>
+
+using namespace OpenTissue;
+
+BOOST_AUTO_TEST_SUITE(opentissue_utility_thread_pool);
+
+  BOOST_AUTO_TEST_CASE(parallel_for_visits_all_indices_once)
+  {
+    OpenTissue::utility::ThreadPool pool(4);
+    BOOST_CHECK( pool.size() == 4u );
+
+    std::vector<int> visits(1000, 0);
+    pool.parallel_for(0u, visits.size(), [&](size_t i){ ++visits[i]; } );
+    for(size_t i = 0u; i < visits.size(); ++i)
+      BOOST_CHECK( visits[i] == 1 );
+
+    // Empty and tiny ranges
+    pool.parallel_for(5u, 5u, [&](size_t i){ ++visits[i]; } );
+    pool.parallel_for(0u, 2u, [&](size_t i){ ++visits[i]; } );
+    BOOST_CHECK( visits[0] == 2 );
+    BOOST_CHECK( visits[1] == 2 );
+    BOOST_CHECK( visits[5] == 1 );
+  }
+
+  BOOST_AUTO_TEST_CASE(blocked_partition_is_static)
+  {
+    OpenTissue::utility::ThreadPool pool(3);
+
+    std::vector<size_t> first(10, 0u);
+    std::vector<size_t> second(10, 0u);
+    pool.parallel_for_blocked(0u, 10u, [&](size_t b, size_t e, size_t t){ for(size_t i=b;i<e;++i) first[i]  = t; } );
+    pool.parallel_for_blocked(0u, 10u, [&](size_t b, size_t e, size_t t){ for(size_t i=b;i<e;++i) second[i] = t; } );
+    for(size_t i = 0u; i < 10u; ++i)
+    {
+      BOOST_CHECK( first[i] == second[i] );
+      BOOST_CHECK( first[i] < pool.size() );
+    }
+    // Blocks are contiguous and ordered by thread number
+    for(size_t i = 1u; i < 10u; ++i)
+      BOOST_CHECK( first[i-1] <= first[i] );
+  }
+
+  BOOST_AUTO_TEST_CASE(nested_invocation_runs_serially)
+  {
+    OpenTissue::utility::ThreadPool pool(2);
+    std::vector<int> visits(100, 0);
+    pool.parallel_for(0u, 10u,
+      [&](size_t i)
+      {
+        pool.parallel_for(0u, 10u, [&](size_t j){ ++visits[10*i + j]; } );
+      }
+    );
+    for(size_t i = 0u; i < visits.size(); ++i)
+      BOOST_CHECK( visits[i] == 1 );
+  }
+
+  BOOST_AUTO_TEST_CASE(exceptions_are_propagated)
+  {
+    OpenTissue::utility::ThreadPool pool(2);
+    BOOST_CHECK_THROW(
+      pool.parallel_for(0u, 10u, [&](size_t i){ if(i==9u) throw std::runtime_error("test"); } )
+      , std::runtime_error
+      );
+    // The pool must still be usable afterwards
+    std::vector<int> visits(10, 0);
+    pool.parallel_for(0u, 10u, [&](size_t i){ ++visits[i]; } );
+    for(size_t i = 0u; i < visits.size(); ++i)
+      BOOST_CHECK( visits[i] == 1 );
+  }
+
+BOOST_AUTO_TEST_SUITE_END();